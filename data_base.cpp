@@ -80,15 +80,24 @@ public:
     int save_img(cv::Mat frame, std::string label, std::string folder) {
         /*
             Save a image to the data base.
+            Each identity has its own subfolder so that several photos of the same person can be stored.
             Args:
                 image (Mat): input image.
                 lable (string): label of the image
                 folder (string): name of folder that the image will be saved to
         */
-        std::string file_path = "./" + folder + "/" + label + ".jpg";
+        std::string identity_folder = "./" + folder + "/" + label;
         // chech if the folder path exist. If not, create one.
-        if (!std::filesystem::exists("./" + folder)) {
-            std::filesystem::create_directories("./" + folder);
+        if (!std::filesystem::exists(identity_folder)) {
+            std::filesystem::create_directories(identity_folder);
+        }
+
+        // Number the photos of the identity so that a new photo does not overwrite the previous ones
+        int index = 0;
+        std::string file_path = identity_folder + "/" + std::to_string(index) + ".jpg";
+        while (std::filesystem::exists(file_path)) {
+            index++;
+            file_path = identity_folder + "/" + std::to_string(index) + ".jpg";
         }
 
         bool result = cv::imwrite(file_path, frame);
@@ -0,0 +1,114 @@
+#include <opencv2/core.hpp>
+
+#include <iostream>
+#include <vector>
+#include "gallery.hpp"
+
+using namespace cv;
+using namespace std;
+
+cv::Mat normalize_feature(const cv::Mat& feature) {
+    /*
+        This function scales a feature to unit L2 norm so that cosine similarity becomes a plain dot product.
+        Args:
+            feature (Mat): Feature extracted by FaceRecognizerSF
+        Output:
+            normalized (Mat): Unit length copy of the feature
+    */
+
+    cv::Mat normalized;
+    cv::normalize(feature, normalized);
+    return normalized;
+}
+
+cv::Mat compute_centroid(const std::vector<cv::Mat>& templates) {
+    /*
+        This function computes the representative feature of an identity.
+        Every template is normalized first so that no single photo dominates the mean.
+        Args:
+            templates (vector<Mat>): Features of all the photos of one identity
+        Output:
+            centroid (Mat): Normalized mean of the templates, empty if there is no template
+    */
+
+    cv::Mat centroid;
+    for (auto& feature : templates) {
+        cv::Mat normalized = normalize_feature(feature);
+        if (centroid.empty()) {
+            centroid = normalized;
+        } else {
+            centroid += normalized;
+        }
+    }
+
+    if (centroid.empty()) {
+        return centroid;
+    }
+    return normalize_feature(centroid);
+}
+
+void write_gallery(const cv::String& path, const std::vector<Identity>& identities) {
+    /*
+        This function stores the enrolled identities in a YAML file.
+        Args:
+            path (String): Path of the output file
+            identities (vector<Identity>): Identities to store
+        Output:
+            None
+    */
+
+    FileStorage fs(path, FileStorage::WRITE);
+    fs << "identities" << "[";
+    for (auto& identity : identities) {
+        fs << "{";
+        fs << "label" << identity.label;
+        fs << "templates" << identity.templates;
+        fs << "centroid" << identity.centroid;
+        fs << "}";
+    }
+    fs << "]";
+    fs.release();
+}
+
+std::vector<Identity> read_gallery(const cv::String& path) {
+    /*
+        This function loads the enrolled identities written by write_gallery.
+        The centroid is recomputed if it is missing from the file.
+        Args:
+            path (String): Path of the input file
+        Output:
+            identities (vector<Identity>): Enrolled identities, empty if the file cannot be read
+    */
+
+    std::vector<Identity> identities;
+    FileStorage fs(path, FileStorage::READ);
+    if (!fs.isOpened()) {
+        cout << "Cannot open " << path << ", run ./train first." << endl;
+        return identities;
+    }
+
+    cv::FileNode identitiesNode = fs["identities"];
+    if (identitiesNode.type() != cv::FileNode::SEQ) {
+        cout << "No identity found in " << path << endl;
+        return identities;
+    }
+
+    for (auto it = identitiesNode.begin(); it != identitiesNode.end(); ++it) {
+        cv::FileNode node = *it;
+        Identity identity;
+        node["label"] >> identity.label;
+        node["templates"] >> identity.templates;
+        node["centroid"] >> identity.centroid;
+
+        if (identity.templates.empty()) {
+            continue;
+        }
+        if (identity.centroid.empty()) {
+            identity.centroid = compute_centroid(identity.templates);
+        }
+        identities.push_back(identity);
+    }
+    fs.release();
+
+    return identities;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+#include <iostream>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+struct Identity {
+    /* An enrolled person: every template extracted from their photos plus the normalized mean of those templates */
+    cv::String label;
+    std::vector<cv::Mat> templates;
+    cv::Mat centroid;
+};
+
+cv::Mat normalize_feature(const cv::Mat& feature);
+cv::Mat compute_centroid(const std::vector<cv::Mat>& templates);
+void write_gallery(const cv::String& path, const std::vector<Identity>& identities);
+std::vector<Identity> read_gallery(const cv::String& path);
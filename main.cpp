@@ -5,7 +5,12 @@
 
 #include <iostream>
 #include <fstream>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <functional>
 #include "utils.hpp"
+#include "gallery.hpp"
 
 using namespace cv;
 using namespace std;
@@ -15,14 +20,16 @@ class Model {
 private:
     cv::Ptr<FaceRecognizerSF> faceRecognizer; // face recognition model
     cv::Ptr<FaceDetectorYN> detector; // face detection model
+    std::vector<Identity> identities; // enrolled identities of the local database
 
 public:
 
     Model(String fd_modelPath, String fr_modelPath, float scoreThreshold, float nmsThreshold, int topK) {
-        /* This method initializes the models to be used */
+        /* This method initializes the models to be used and loads the local database */
 
         this->detector = FaceDetectorYN::create(fd_modelPath, "", Size(320, 320), scoreThreshold, nmsThreshold, topK);
         this->faceRecognizer = FaceRecognizerSF::create(fr_modelPath, "");
+        this->identities = read_gallery("groundTruthFaces.yml");
     }
 
     std::vector<cv::Mat> detection(cv::Mat image) {
@@ -64,52 +71,49 @@ public:
         return out;
     }
     
-    String verification(Mat feature, double cosine_similar_thresh, double l2norm_similar_thresh) {
+    String verification(Mat feature, double cosine_similar_thresh, double l2norm_similar_thresh, int top_identities) {
         /*
             This method verifies the identity of the detected face according to the local databse.
+            Only the centroid of every identity is scored first, then the templates of the
+            top_identities best identities are compared against the face.
             Args:
                 feature (Mat): Feature of the detected face
                 cosine_similar_thresh (double): Threshold of cosine similarity
                 l2norm_similar_thresh (double): Threshold of L2 norm similarity
+                top_identities (int): Number of identities whose templates are compared
             Output:
                 label (String): Name of the detected person
         */
         
         cout << "Detected face, verifying identity..." << endl;
 
-        // Read features and labels from database
-        String databasePath = "groundTruthFaces.yml";
-        FileStorage fs(databasePath, FileStorage::READ);
-
-        vector<Mat> features;
-        vector<String> labels;
-        // Read features as vector<Mat>
-        cv::FileNode featuresNode = fs["features"];
-        if (featuresNode.type() == cv::FileNode::SEQ) {
-            featuresNode >> features;
-        }
-        // Read labels as vector<String>
-        cv::FileNode labelsNode = fs["labels"];
-        if (labelsNode.type() == cv::FileNode::SEQ) {
-            labelsNode >> labels;
+        // Centroids are normalized, so the cosine similarity is a dot product with the normalized feature
+        cv::Mat probe = normalize_feature(feature);
+        vector<pair<double, int>> centroid_scores;
+        for (int i = 0; i < this->identities.size(); i++) {
+            centroid_scores.push_back(make_pair(probe.dot(this->identities[i].centroid), i));
         }
-        fs.release();
-        
-        // Loop over all the ground truth faces
+
+        // Keep only the identities with the closest centroids
+        int n_candidates = min(max(top_identities, 1), int(centroid_scores.size()));
+        partial_sort(centroid_scores.begin(), centroid_scores.begin() + n_candidates, centroid_scores.end(), greater<pair<double, int>>());
+
+        // Loop over all the templates of the candidate identities
         String label;
         double max_cos_score = 0;
-        // double min_l2_score = 100;
-        for (int i = 0; i < features.size(); i++) {
-            // Compute cosine similarity
-            double cos_score = this->faceRecognizer->match(feature, features[i], FaceRecognizerSF::DisType::FR_COSINE);
-            // Compute L2 norm similarity
-            double L2_score = this->faceRecognizer->match(feature, features[i], FaceRecognizerSF::DisType::FR_NORM_L2);
-            // Compare cosine similarity and L2 norm similarity with the thresholds
-            if (cos_score >= cosine_similar_thresh && L2_score <= l2norm_similar_thresh) {
-                if (cos_score > max_cos_score) {
-                    max_cos_score = cos_score;
-                    // min_l2_score = L2_score;
-                    label = labels[i];
+        for (int k = 0; k < n_candidates; k++) {
+            const Identity& identity = this->identities[centroid_scores[k].second];
+            for (auto& feature_i : identity.templates) {
+                // Compute cosine similarity
+                double cos_score = this->faceRecognizer->match(feature, feature_i, FaceRecognizerSF::DisType::FR_COSINE);
+                // Compute L2 norm similarity
+                double L2_score = this->faceRecognizer->match(feature, feature_i, FaceRecognizerSF::DisType::FR_NORM_L2);
+                // Compare cosine similarity and L2 norm similarity with the thresholds
+                if (cos_score >= cosine_similar_thresh && L2_score <= l2norm_similar_thresh) {
+                    if (cos_score > max_cos_score) {
+                        max_cos_score = cos_score;
+                        label = identity.label;
+                    }
                 }
             }
         }
@@ -165,7 +169,7 @@ public:
         }
     }
 
-    cv::Mat forward(cv::Mat &image, float scale, double cosine_similar_thresh, double l2norm_similar_thresh) {
+    cv::Mat forward(cv::Mat &image, float scale, double cosine_similar_thresh, double l2norm_similar_thresh, int top_identities) {
         /* This method combines and runs a forward pass of detecting and verifying face */
 
         // Detect faces and extract features
@@ -175,7 +179,7 @@ public:
 
         for (auto i = out.begin() + 1; i != out.end(); ++i) {
             cv::Mat feature = *i;
-            String label = this->verification(feature, cosine_similar_thresh, l2norm_similar_thresh);
+            String label = this->verification(feature, cosine_similar_thresh, l2norm_similar_thresh, top_identities);
             if (!label.empty()) {
                 this->attendance_check(label);
                 show_label(result, label);
@@ -200,6 +204,7 @@ int main(int argc, char** argv)
         "{score_threshold   | 0.9        | Filter out faces of score < score_threshold}"
         "{nms_threshold     | 0.3        | Suppress bounding boxes of iou >= nms_threshold}"
         "{top_k             | 5000       | Keep top_k bounding boxes before NMS}"
+        "{top_identities    | 3          | Number of identities with the closest centroids whose templates are compared}"
     );
     if (parser.has("help"))
     {
@@ -213,6 +218,7 @@ int main(int argc, char** argv)
     float scoreThreshold = parser.get<float>("score_threshold");
     float nmsThreshold = parser.get<float>("nms_threshold");
     int topK = parser.get<int>("top_k");
+    int topIdentities = parser.get<int>("top_identities");
 
     float scale = parser.get<float>("scale");
 
@@ -238,6 +244,9 @@ int main(int argc, char** argv)
 
     std::cout << "Press any key to exit..." << endl;
 
+    // Load the models and the database once for the whole video
+    Verification verification_instance(fd_modelPath, fr_modelPath, scoreThreshold, nmsThreshold, topK);
+
     int nFrame = 0;
     while(true)
     {
@@ -253,8 +262,7 @@ int main(int argc, char** argv)
         cv::flip(frame, frame, 1);
 
         // Detect and verify face
-        Verification verification_instance(fd_modelPath, fr_modelPath, scoreThreshold, nmsThreshold, topK);
-        Mat result = verification_instance.forward(frame, scale, cosine_similar_thresh, l2norm_similar_thresh);
+        Mat result = verification_instance.forward(frame, scale, cosine_similar_thresh, l2norm_similar_thresh, topIdentities);
         imshow(window_name, result);
 
         ++nFrame;
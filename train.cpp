@@ -6,7 +6,9 @@
     These images are then processed by the face detection model to extract features.
     The used models here are the same models which are used in real time face verification application.
 
-    The set of features of each face is then stored in a ground truth folder.
+    Photos of the same person are grouped into one identity holding all of their features (templates)
+    and the normalized mean of these features (centroid).
+    The set of identities is then stored in a ground truth file.
 */
 
 #include <opencv2/dnn.hpp>
@@ -16,8 +18,10 @@
 
 #include <iostream>
 #include <vector>
+#include <map>
 #include <filesystem>
 #include "detection.hpp"
+#include "gallery.hpp"
 
 using namespace cv;
 using namespace std;
@@ -57,45 +61,61 @@ int main(int argc, char** argv)
     // Initialize FaceRecognizerSF to the smart pointer faceRecognizer
     cv::Ptr<cv::FaceRecognizerSF> faceRecognizer = cv::FaceRecognizerSF::create(fr_modelPath, "");
 
-    // Read images and their names in database
-    std::vector<cv::Mat> images;
-    std::vector<cv::String> imageNames;
+    // Read images and their identities in database.
+    // A subfolder database/<identity>/ holds several photos of one person,
+    // a single file database/<identity>.jpg is also accepted.
+    std::vector<cv::String> imagePaths;
+    std::vector<cv::String> imageLabels;
     for (auto& entry : filesystem::directory_iterator(databasePath)) {
-        imageNames.push_back(entry.path().string());
-        cv::Mat image = imread(entry.path().string());
-        if (!image.empty()) {
-            images.push_back(image);
+        if (entry.is_directory()) {
+            cv::String faceName = entry.path().filename().string();
+            for (auto& photo : filesystem::directory_iterator(entry.path())) {
+                if (photo.is_regular_file()) {
+                    imagePaths.push_back(photo.path().string());
+                    imageLabels.push_back(faceName);
+                }
+            }
+        } else if (entry.is_regular_file()) {
+            imagePaths.push_back(entry.path().string());
+            imageLabels.push_back(entry.path().filename().stem().string());
         }
     }
 
-    // Setup the file to store the ground truth features and labels
-    FileStorage fs("groundTruthFaces.yml", FileStorage::WRITE);
+    /* Process all the images, grouping the features of the same person into one identity */
+    vector<Identity> identities;
+    std::map<cv::String, size_t> identityIndex;
+    for (size_t i = 0; i < imagePaths.size(); i++) {
+        cv::Mat image = imread(imagePaths[i]);
+        if (image.empty()) {
+            continue;
+        }
 
-    /* Process all the images */
-    vector<cv::Mat> features;
-    vector<cv::String> labels;
-    for (auto& image : images) {
-        
         std::vector<cv::Mat> out = detection(image, detector, faceRecognizer, scale);
         cv::Mat feature = out[1];
 
         if (feature.empty()) {
-            cout << "No face detected in " << imageNames[&image - &images[0]] << endl;
+            cout << "No face detected in " << imagePaths[i] << endl;
             continue;
         };
 
-        // Save the feature to the ground truth feature vector
-        features.push_back(feature);
+        // Save the feature to the templates of its identity
+        if (identityIndex.find(imageLabels[i]) == identityIndex.end()) {
+            Identity identity;
+            identity.label = imageLabels[i];
+            identityIndex[imageLabels[i]] = identities.size();
+            identities.push_back(identity);
+        }
+        identities[identityIndex[imageLabels[i]]].templates.push_back(feature);
+    }
 
-        // Save the face name to the labels vector
-        cv::String faceName = filesystem::path(imageNames[&image - &images[0]]).filename().stem().string();
-        labels.push_back(faceName);
+    // Precompute the centroid of each identity, used to prune the search during verification
+    for (auto& identity : identities) {
+        identity.centroid = compute_centroid(identity.templates);
+        cout << identity.label << ": " << identity.templates.size() << " template(s)" << endl;
     }
 
-    // Write the ground truth features and labels to the file
-    fs << "features" << features;
-    fs << "labels" << labels;
-    fs.release();
+    // Write the identities to the ground truth file
+    write_gallery("groundTruthFaces.yml", identities);
     
     std::cout << "Feature extraction done." << std::endl;
     return 0;